@@ -0,0 +1,5 @@
+#pragma once
+
+#include "settings.hpp"
+
+void runMesh(const Settings& settings);
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Online outlier classifier. A sample is an outlier when it is above the hard threshold (-T), or when it is more than
+// factor * MAD above the median of the most recent samples (-O). Classifying never blocks the probe loop.
+class OutlierDetector {
+public:
+    OutlierDetector(double factor, int threshold, std::size_t windowSize = 128);
+
+    bool classify(std::uint64_t sample);
+
+private:
+    double factor;
+    int threshold;
+    std::vector<std::uint64_t> window;
+    std::vector<std::uint64_t> scratch;
+    std::size_t next = 0;
+    std::size_t filled = 0;
+};
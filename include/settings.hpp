@@ -1,6 +1,7 @@
 #pragma once
 
 #include <string>
+#include <vector>
 
 enum Mode {
     TCP,
@@ -18,7 +19,12 @@ struct Settings {
     int interval = 1;
     std::string output;
     int threshold = -1;
+    double outlierFactor = -1;
+    int backoff = 0;
     std::string ip;
+    std::vector<std::string> destinations;
+    int roundInterval = 10000;
+    bool isMesh = false;
     bool isServer = false;
 };
 
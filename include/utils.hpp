@@ -3,12 +3,17 @@
 #include <optional>
 #include <string>
 #include <thread>
+#include <vector>
 
 #include "protocol.hpp"
+#include "settings.hpp"
 
 std::string toLowerCase(std::string input);
 int safeStoi(const std::string& input);
+double safeStod(const std::string& input);
 bool validateIpAddress(const std::string& ipAddress);
 std::optional<int> setupThread(const pthread_t& thread);
 bool lockMemory();
-std::optional<Message> recvMessage(const int& sock);
\ No newline at end of file
+std::optional<Message> recvMessage(const int& sock, Mode mode);
+std::vector<std::string> splitString(const std::string& input, char delimiter);
+std::uint64_t percentile(const std::vector<std::uint64_t>& sorted, double fraction);
\ No newline at end of file
@@ -10,7 +10,9 @@
 #include <netinet/in.h>
 #include <cstring>
 #include <arpa/inet.h>
+#include <vector>
 
+#include "outlier.hpp"
 #include "signal.hpp"
 #include "utils.hpp"
 
@@ -43,6 +45,8 @@ static int setupSocket(const Settings &settings) {
 
 void runClient(const Settings &settings) {
     uint64_t runTime = 0;
+    uint64_t runOutliers = 0;
+    OutlierDetector outlierDetector(settings.outlierFactor, settings.threshold);
     int sock = setupSocket(settings);
 
     std::optional<std::ofstream> outputFile;
@@ -52,6 +56,7 @@ void runClient(const Settings &settings) {
 
     for (int test = 0; test < settings.tests && running; test++) {
         uint64_t testTime = 0;
+        uint64_t testOutliers = 0;
 
         if (outputFile.has_value()) {
             *outputFile << "Test " << test << std::endl;
@@ -62,6 +67,8 @@ void runClient(const Settings &settings) {
 
         for (int batch = 0; batch < settings.batches && running; batch++) {
             uint64_t batchTime = 0;
+            uint64_t batchSamples = 0;
+            uint64_t batchOutliers = 0;
 
             bool doneHopping = false;
             for (int messageCount = 0; messageCount < settings.count && running && !doneHopping; messageCount++) {
@@ -91,30 +98,34 @@ void runClient(const Settings &settings) {
                 int hops = settings.hops;
 
                 while (hops > 0) {
-                    const std::optional<Message> message = recvMessage(sock);
+                    const std::optional<Message> message = recvMessage(sock, settings.mode);
+                    if (!message.has_value()) {
+                        std::cerr << "Lost connection to " << settings.ip << std::endl;
+                        exit(-1);
+                    }
                     if (message->protocol.hops <= 1) {
                         uint64_t timeDifference = 0;
                         timeDifference = message->timestamp - message->protocol.timestamp;
 
 
-                        if (settings.threshold > 0) {
-                            if (timeDifference > settings.threshold) {
-                                batch--;
-                                std::cout << "Hit threshold! waiting 5 seconds." << std::endl;
-                                std::this_thread::sleep_for(std::chrono::seconds(5));
-                            } else {
-                                batchTime += timeDifference;
+                        if (outlierDetector.classify(timeDifference)) {
+                            batchOutliers++;
+                            if (outputFile.has_value()) {
+                                *outputFile << "Outlier received: " << timeDifference << "us" << std::endl;
+                            }
+                            if (settings.backoff > 0) {
+                                std::this_thread::sleep_for(std::chrono::milliseconds(settings.backoff));
                             }
                         } else {
                             batchTime += timeDifference;
-                        }
-
-                        if (outputFile.has_value()) {
-                            *outputFile << "Message received. Current batchtime: " << batchTime << "us" << std::endl;
+                            batchSamples++;
+                            if (outputFile.has_value()) {
+                                *outputFile << "Message received. Current batchtime: " << batchTime << "us" << std::endl;
+                            }
                         }
                         break;
                     } else {
-                        std::vector<unsigned char> bounceBuffer(settings.size, 255);
+                        std::vector<unsigned char> bounceBuffer(message->protocol.size, 255);
                         unsigned char* bouncePtr = bounceBuffer.data();
 
                         hops = message->protocol.hops;
@@ -138,14 +149,20 @@ void runClient(const Settings &settings) {
             }
 
 
+            const uint64_t batchAverage = batchSamples > 0 ? batchTime / batchSamples : 0;
             if (outputFile.has_value()) {
                 *outputFile << std::endl;
                 *outputFile << "Total message time: " << batchTime << "us" << std::endl;
-                *outputFile << "Average message time: " << batchTime / settings.count << "us" << std::endl;
+                *outputFile << "Average message time: " << batchAverage << "us" << std::endl;
+                *outputFile << "Outliers: " << batchOutliers << std::endl;
             }
             std::cout << "Total message time for batch " << batch <<  ": " << batchTime << "us" << std::endl;
-            std::cout << "Average message time for batch " << batch << ": " << batchTime / settings.count << "us" << std::endl;
+            std::cout << "Average message time for batch " << batch << ": " << batchAverage << "us" << std::endl;
+            if (batchOutliers > 0) {
+                std::cout << "Outliers for batch " << batch << ": " << batchOutliers << std::endl;
+            }
             testTime += batchTime;
+            testOutliers += batchOutliers;
             std::this_thread::sleep_for(std::chrono::milliseconds(10));
         }
 
@@ -153,10 +170,12 @@ void runClient(const Settings &settings) {
             *outputFile << std::endl;
             *outputFile << "Total batch time: " << testTime << "us" << std::endl;
             *outputFile << "Average batch time: " << testTime / settings.batches << "us" << std::endl;
+            *outputFile << "Outliers: " << testOutliers << std::endl;
         }
         std::cout << std::endl;
         std::cout << "Total batch time for test " << test << ": " << testTime << "us" << std::endl;
         std::cout << "Average batch time for test " << test << ": " << testTime / settings.batches << "us" << std::endl;
+        std::cout << "Outliers for test " << test << ": " << testOutliers << std::endl;
 
 
         if (outputFile.has_value()) {
@@ -166,16 +185,19 @@ void runClient(const Settings &settings) {
         std::this_thread::sleep_for(std::chrono::seconds(settings.interval));
 
         runTime += testTime;
+        runOutliers += testOutliers;
     }
 
     if (outputFile.has_value()) {
         *outputFile << "==============================================" << std::endl;
         *outputFile << "Total batch time: " << runTime << "us" << std::endl;
         *outputFile << "Average batch time: " << runTime / static_cast<long double>(settings.tests) / static_cast<long double>(1000000.0) << "s" << std::endl;
+        *outputFile << "Total outliers: " << runOutliers << std::endl;
     }
     std::cout << std::endl;
     std::cout << "Total test time: " << runTime / static_cast<long double>(1000000.0) << "s" << std::endl;
     std::cout << "Average test time: " << runTime / static_cast<long double>(settings.tests) / static_cast<long double>(1000000.0) << "s" << std::endl;
+    std::cout << "Total outliers: " << runOutliers << std::endl;
 
     if (outputFile.has_value()) {
         outputFile->close();
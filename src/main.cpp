@@ -6,6 +6,7 @@
 #include <unistd.h>
 
 #include "client.hpp"
+#include "mesh.hpp"
 #include "server.hpp"
 #include "settings.hpp"
 #include "utils.hpp"
@@ -20,15 +21,23 @@ std::optional<int> getCommandLineOptions(Settings &settings, const int argc, cha
 
     settings.isServer = isServer;
 
-    const std::string flags = isServer ? "hp:m:" : "hp:m:H:c:s:t:b:i:o:T:";
+    const std::string flags = isServer ? "hp:m:" : "hp:m:H:c:s:t:b:i:o:T:R:O:B:";
 
     if (!isServer) {
-        if (validateIpAddress(argv[1])) {
-            settings.ip = argv[1];
-        } else {
+        settings.destinations = splitString(argv[1], ',');
+        settings.isMesh = settings.destinations.size() > 1;
+
+        if (settings.destinations.empty()) {
             std::cerr << argv[1] << " is not a valid IP address" << std::endl;
             return -1;
         }
+        for (const std::string& destination : settings.destinations) {
+            if (!validateIpAddress(destination)) {
+                std::cerr << destination << " is not a valid IP address" << std::endl;
+                return -1;
+            }
+        }
+        settings.ip = settings.destinations.front();
     }
 
     int opt;
@@ -120,6 +129,33 @@ std::optional<int> getCommandLineOptions(Settings &settings, const int argc, cha
                 }
                 break;
             }
+            case 'O': {
+                if (const double factor = safeStod(optarg); factor > 0) {
+                    settings.outlierFactor = factor;
+                } else {
+                    std::cerr << optarg << " is not a valid outlier factor" << std::endl;
+                    return -1;
+                }
+                break;
+            }
+            case 'B': {
+                if (const int backoff = safeStoi(optarg); backoff > 0) {
+                    settings.backoff = backoff;
+                } else {
+                    std::cerr << optarg << " is not a valid backoff" << std::endl;
+                    return -1;
+                }
+                break;
+            }
+            case 'R': {
+                if (const int roundInterval = safeStoi(optarg); roundInterval > 0) {
+                    settings.roundInterval = roundInterval;
+                } else {
+                    std::cerr << optarg << " is not a valid round interval" << std::endl;
+                    return -1;
+                }
+                break;
+            }
             case 'm': {
                 if (toLowerCase(optarg) == "tcp") {
                     settings.mode = TCP;
@@ -159,7 +195,11 @@ int main(const int argc, char *argv[]) {
         if (const std::optional<int> thrCliResult = setupThread(pthread_self()); thrCliResult.has_value()) {
             return thrCliResult.value();
         }
-        runClient(settings);
+        if (settings.isMesh) {
+            runMesh(settings);
+        } else {
+            runClient(settings);
+        }
     }
     return 0;
 }
@@ -0,0 +1,302 @@
+#include "mesh.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+#include <ostream>
+#include <poll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <utility>
+#include <vector>
+
+#include "outlier.hpp"
+#include "signal.hpp"
+#include "utils.hpp"
+
+struct Peer {
+    Peer(std::string ip, const int sock, const OutlierDetector &outlierDetector)
+        : ip(std::move(ip)), sock(sock), outlierDetector(outlierDetector) {}
+
+    std::string ip;
+    int sock = -1;
+    bool alive = true;
+    std::optional<std::size_t> outstandingRound;
+    std::uint64_t outstandingTimestamp = 0;
+    std::size_t skipped = 0;
+    std::chrono::steady_clock::time_point backoffUntil;
+    OutlierDetector outlierDetector;
+    std::vector<std::uint64_t> samples;
+    std::vector<std::uint64_t> outliers;
+};
+
+static int setupSocket(const Settings &settings, const std::string &ip) {
+    const int sock = socket(AF_INET, settings.mode == UDP ? SOCK_DGRAM : SOCK_STREAM, 0);
+
+    if (sock < 0) {
+        std::cerr << "Error creating socket" << std::endl;
+        exit(-1);
+    }
+
+    constexpr int busy_poll_interval = 50;
+    if (setsockopt(sock, SOL_SOCKET, SO_BUSY_POLL, &busy_poll_interval, sizeof(busy_poll_interval)) < 0) {
+        std::cerr << "Error setting SO_BUSY_POLL" << std::endl;
+        exit(-1);
+    }
+
+    // A new probe can go out while the previous one is unanswered, Nagle would hold it back until that is ACKed.
+    if (settings.mode == TCP) {
+        constexpr int noDelay = 1;
+        if (setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay)) < 0) {
+            std::cerr << "Error setting TCP_NODELAY" << std::endl;
+            exit(-1);
+        }
+    }
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(settings.port);
+    addr.sin_addr.s_addr = inet_addr(ip.c_str());
+
+    if (connect(sock, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0) {
+        std::cerr << "Error connecting to " << ip << ": " << strerror(errno) << std::endl;
+        exit(-1);
+    }
+
+    return sock;
+}
+
+static std::uint64_t now() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+static bool sendProbe(const Peer &peer, std::vector<unsigned char> &buffer, const std::uint32_t size,
+                      const std::uint64_t timestamp, const unsigned char hops) {
+    unsigned char* ptr = buffer.data();
+
+    int index = 0;
+    std::memcpy(ptr + index, &size, 4);
+    index += 4;
+    std::memcpy(ptr + index, &timestamp, 8);
+    index += 8;
+    std::memcpy(ptr + index, &hops, 1);
+
+    return send(peer.sock, ptr, size, MSG_NOSIGNAL) >= 0;
+}
+
+// recvMessage closes the socket itself when it fails, every other path needs it closed here.
+static void dropPeer(Peer &peer, pollfd &fd, const bool closeSocket) {
+    if (peer.alive) {
+        std::cerr << "Lost connection to " << peer.ip << std::endl;
+        if (closeSocket) {
+            close(peer.sock);
+        }
+    }
+    peer.alive = false;
+    peer.outstandingRound.reset();
+    fd.fd = -1;
+}
+
+void runMesh(const Settings &settings) {
+    std::vector<Peer> peers;
+    std::vector<pollfd> fds;
+    peers.reserve(settings.destinations.size());
+    fds.reserve(settings.destinations.size());
+
+    for (const std::string &ip : settings.destinations) {
+        peers.emplace_back(ip, setupSocket(settings, ip), OutlierDetector(settings.outlierFactor, settings.threshold));
+        fds.push_back({peers.back().sock, POLLIN, 0});
+    }
+
+    const std::size_t rounds = static_cast<std::size_t>(settings.tests) * settings.batches * settings.count;
+    const std::size_t totalSlots = rounds * peers.size();
+
+    // One row per round, one column per destination. Filled in as responses arrive.
+    std::vector<std::optional<std::uint64_t>> matrix(totalSlots);
+    std::vector<bool> outlierCells(totalSlots, false);
+    std::vector<std::uint64_t> roundOffsets(rounds, 0);
+    for (Peer &peer : peers) {
+        peer.samples.reserve(rounds);
+    }
+
+    std::vector<unsigned char> buffer(settings.size, 255);
+
+    const auto drainTime = std::max<std::chrono::microseconds>(std::chrono::microseconds(settings.roundInterval),
+                                                                std::chrono::seconds(1));
+
+    std::cout << "Starting mesh: " << peers.size() << " destinations, " << rounds << " rounds" << std::endl
+            << std::endl;
+
+    const std::uint64_t startTimestamp = now();
+    const auto start = std::chrono::steady_clock::now();
+    std::size_t slot = 0;
+
+    // Every destination gets its own slot inside a round, so probes are spread evenly and no target sees a burst.
+    // Computed per slot in nanoseconds, so a short round over many destinations does not round the spacing to 0.
+    const auto slotTime = [&](const std::size_t index) {
+        return start + std::chrono::nanoseconds(std::chrono::microseconds(settings.roundInterval)) *
+                       static_cast<long>(index) / static_cast<long>(peers.size());
+    };
+
+    while (running) {
+        const auto current = std::chrono::steady_clock::now();
+
+        while (slot < totalSlots && slotTime(slot) <= current) {
+            const std::size_t round = slot / peers.size();
+            Peer &peer = peers[slot % peers.size()];
+
+            if (slot % peers.size() == 0) {
+                roundOffsets[round] = now() - startTimestamp;
+            }
+
+            // A peer in backoff skips its slots, the other destinations keep their schedule.
+            if (peer.alive && peer.backoffUntil > current) {
+                peer.skipped++;
+            } else if (peer.alive) {
+                // An unanswered probe from the previous round is counted as lost, a late response is ignored.
+                peer.outstandingRound = round;
+                peer.outstandingTimestamp = now();
+                if (!sendProbe(peer, buffer, settings.size, peer.outstandingTimestamp, settings.hops)) {
+                    std::cerr << "Error writing to " << peer.ip << ": " << strerror(errno) << std::endl;
+                    dropPeer(peer, fds[slot % peers.size()], true);
+                }
+            }
+            slot++;
+        }
+
+        std::chrono::nanoseconds timeout;
+        if (slot < totalSlots) {
+            timeout = slotTime(slot) - current;
+        } else {
+            const bool waiting = std::ranges::any_of(peers, [](const Peer &peer) {
+                return peer.outstandingRound.has_value();
+            });
+            const auto remaining = slotTime(totalSlots) + drainTime - current;
+            if (!waiting || remaining <= std::chrono::nanoseconds::zero()) {
+                break;
+            }
+            timeout = remaining;
+        }
+
+        const timespec pollTimeout{
+            static_cast<time_t>(std::chrono::duration_cast<std::chrono::seconds>(timeout).count()),
+            static_cast<long>((timeout % std::chrono::seconds(1)).count())
+        };
+
+        if (ppoll(fds.data(), fds.size(), &pollTimeout, nullptr) <= 0) {
+            continue;
+        }
+
+        for (std::size_t i = 0; i < peers.size(); i++) {
+            Peer &peer = peers[i];
+            if (fds[i].fd < 0 || fds[i].revents == 0) {
+                continue;
+            }
+
+            if (fds[i].revents & (POLLERR | POLLHUP | POLLNVAL)) {
+                dropPeer(peer, fds[i], true);
+                continue;
+            }
+
+            const std::optional<Message> message = recvMessage(peer.sock, settings.mode);
+            if (!message.has_value()) {
+                dropPeer(peer, fds[i], false);
+                continue;
+            }
+
+            // Every probe is settings.size bytes, anything else is not ours and would not fit the bounce buffer.
+            if (message->protocol.size != buffer.size()) {
+                continue;
+            }
+
+            if (message->protocol.hops > 1) {
+                const auto hops = static_cast<unsigned char>(message->protocol.hops - 1);
+                if (!sendProbe(peer, buffer, message->protocol.size, message->protocol.timestamp, hops)) {
+                    std::cerr << "Error writing to " << peer.ip << ": " << strerror(errno) << std::endl;
+                    dropPeer(peer, fds[i], true);
+                }
+                continue;
+            }
+
+            if (!peer.outstandingRound.has_value() || message->protocol.timestamp != peer.outstandingTimestamp) {
+                continue;
+            }
+
+            const std::uint64_t timeDifference = message->timestamp - message->protocol.timestamp;
+            const std::size_t cell = *peer.outstandingRound * peers.size() + i;
+            matrix[cell] = timeDifference;
+            peer.outstandingRound.reset();
+
+            if (peer.outlierDetector.classify(timeDifference)) {
+                outlierCells[cell] = true;
+                peer.outliers.push_back(timeDifference);
+                peer.backoffUntil = std::chrono::steady_clock::now() + std::chrono::milliseconds(settings.backoff);
+            } else {
+                peer.samples.push_back(timeDifference);
+            }
+        }
+    }
+
+    if (!settings.output.empty()) {
+        std::ofstream outputFile(settings.output);
+
+        outputFile << std::left << std::setw(8) << "Round" << std::setw(14) << "Offset(us)";
+        for (const Peer &peer : peers) {
+            outputFile << std::setw(18) << peer.ip;
+        }
+        outputFile << std::endl;
+
+        for (std::size_t round = 0; round < rounds; round++) {
+            outputFile << std::setw(8) << round << std::setw(14) << roundOffsets[round];
+            for (std::size_t i = 0; i < peers.size(); i++) {
+                if (const auto &cell = matrix[round * peers.size() + i]; cell.has_value()) {
+                    // Outliers are marked with a trailing '*'.
+                    const bool outlier = outlierCells[round * peers.size() + i];
+                    outputFile << std::setw(18) << std::to_string(*cell) + (outlier ? "*" : "");
+                } else {
+                    outputFile << std::setw(18) << "-";
+                }
+            }
+            outputFile << std::endl;
+        }
+    }
+
+    std::cout << std::left << std::setw(18) << "Destination" << std::setw(10) << "Received"
+            << std::setw(10) << "Loss(%)" << std::setw(10) << "Skipped" << std::setw(10) << "Outliers"
+            << std::setw(10) << "Min" << std::setw(10) << "P50" << std::setw(10) << "P90"
+            << std::setw(10) << "P99" << std::setw(10) << "Max" << std::endl;
+
+    for (Peer &peer : peers) {
+        std::ranges::sort(peer.samples);
+        const std::size_t received = peer.samples.size() + peer.outliers.size();
+        // Slots skipped during backoff are reported on their own, every other unanswered round is lost.
+        const long double loss = rounds == 0
+                                     ? 0
+                                     : 100.0L * static_cast<long double>(rounds - peer.skipped - received) / rounds;
+
+        std::cout << std::setw(18) << peer.ip << std::setw(10) << received
+                << std::setw(10) << std::setprecision(3) << loss << std::setw(10) << peer.skipped
+                << std::setw(10) << peer.outliers.size();
+        for (const double fraction : {0.0, 0.5, 0.9, 0.99, 1.0}) {
+            // Like the matrix, a destination without samples shows '-' instead of a 0us latency.
+            if (peer.samples.empty()) {
+                std::cout << std::setw(10) << "-";
+            } else {
+                std::cout << std::setw(10) << percentile(peer.samples, fraction);
+            }
+        }
+        std::cout << std::endl;
+
+        if (peer.alive) {
+            close(peer.sock);
+        }
+    }
+    std::cout << std::endl << "All times in us, percentiles exclude outliers" << std::endl;
+}
@@ -0,0 +1,50 @@
+#include "outlier.hpp"
+
+#include <algorithm>
+
+// Samples needed before the median/MAD rule kicks in, below this only the hard threshold applies.
+static constexpr std::size_t minimumSamples = 16;
+
+// Scales the MAD to the standard deviation of a normal distribution.
+static constexpr double madScale = 1.4826;
+
+// Lower bound for the deviation, as a fraction of the median.
+static constexpr double minimumDeviation = 0.05;
+
+static std::uint64_t median(std::vector<std::uint64_t> &values) {
+    const auto middle = values.begin() + static_cast<long>(values.size() / 2);
+    std::ranges::nth_element(values, middle);
+    return *middle;
+}
+
+OutlierDetector::OutlierDetector(const double factor, const int threshold, const std::size_t windowSize)
+    : factor(factor), threshold(threshold), window(windowSize, 0) {
+    scratch.reserve(windowSize);
+}
+
+bool OutlierDetector::classify(const std::uint64_t sample) {
+    bool outlier = threshold > 0 && sample > static_cast<std::uint64_t>(threshold);
+
+    if (!outlier && factor > 0 && filled >= minimumSamples) {
+        scratch.assign(window.begin(), window.begin() + static_cast<long>(filled));
+        const std::uint64_t center = median(scratch);
+
+        for (std::uint64_t &value : scratch) {
+            value = value > center ? value - center : center - value;
+        }
+        // On a very stable link the MAD can be 0, which would flag anything above the median. The deviation is
+        // floored at 5% of the median (and at least 1us), so with -O 3 a sample has to be 15% above the median.
+        const double deviation = std::max({static_cast<double>(median(scratch)) * madScale,
+                                           static_cast<double>(center) * minimumDeviation, 1.0});
+
+        // Only slow samples count, a response can not be faster than the link allows.
+        outlier = static_cast<double>(sample) > static_cast<double>(center) + factor * deviation;
+    }
+
+    // Outliers stay in the window, so the median follows the link when its latency shifts for good.
+    window[next] = sample;
+    next = (next + 1) % window.size();
+    filled = std::min(filled + 1, window.size());
+
+    return outlier;
+}
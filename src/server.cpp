@@ -5,7 +5,9 @@
 #include <sys/socket.h>
 #include <linux/net_tstamp.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <cstring>
+#include <poll.h>
 #include <vector>
 
 #include "signal.hpp"
@@ -53,53 +55,99 @@ static int setupSocket(const Settings &settings) {
     return sock;
 }
 
-void runServer(const Settings &settings) {
-    int sock = 0;
+static bool sendReply(const Settings &settings, const int sock, const Message &message) {
+    std::vector<unsigned char> buffer(message.protocol.size, 255);
+    unsigned char* ptr = buffer.data();
 
-    while (running) {
-        const int clientSock = setupSocket(settings);
-        if (settings.mode == TCP) {
-            sock = accept(clientSock, nullptr, nullptr);
-            close(clientSock);
-            constexpr int busy_poll_interval = 50;
-            if (setsockopt(sock, SOL_SOCKET, SO_BUSY_POLL, &busy_poll_interval, sizeof(busy_poll_interval)) < 0) {
-                std::cerr << "Error setting SO_BUSY_POLL" << std::endl;
-                exit(-1);
-            }
-        } else {
-            sock = clientSock;
-        }
 
-        while (running) {
-            const std::optional<Message> message = recvMessage(sock);
-
-            if (!message.has_value()) {
-                break;
-            }
+    unsigned char hops = message.protocol.hops;
+    hops--;
+    int index = 0;
+    std::memcpy(ptr + index, &message.protocol.size, sizeof(message.protocol.size));
+    index += sizeof(message.protocol.size);
 
-            std::vector<unsigned char> buffer(message->protocol.size, 255);
-            unsigned char* ptr = buffer.data();
+    std::memcpy(ptr + index, &message.protocol.timestamp, sizeof(message.protocol.timestamp));
+    index += sizeof(message.protocol.timestamp);
 
+    std::memcpy(ptr + index, &hops, 1);
 
-            unsigned char hops = message->protocol.hops;
-            hops--;
-            int index = 0;
-            std::memcpy(ptr + index, &message->protocol.size, sizeof(message->protocol.size));
-            index += sizeof(message->protocol.size);
+    if (settings.mode == TCP) {
+        // MSG_NOSIGNAL, a client that went away must not raise SIGPIPE and take the whole server down.
+        if (const ssize_t sent = send(sock, ptr, message.protocol.size, MSG_NOSIGNAL); sent < 0) {
+            std::cerr << "Error writing to socket: " << strerror(errno) << std::endl;
+            return false;
+        }
+    } else {
+        sendto(sock, ptr, message.protocol.size, 0, reinterpret_cast<const sockaddr *>(&message.sender), sizeof(message.sender));
+    }
+    return true;
+}
 
-            std::memcpy(ptr + index, &message->protocol.timestamp, sizeof(message->protocol.timestamp));
-            index += sizeof(message->protocol.timestamp);
+void runServer(const Settings &settings) {
+    // The first entry is the listening (TCP) or bound (UDP) socket, every accepted TCP client is added after it.
+    // Serving all of them from one poll loop lets several clients, like mesh runs on other nodes, probe at once.
+    std::vector<pollfd> fds{{setupSocket(settings), POLLIN, 0}};
 
-            std::memcpy(ptr + index, &hops, 1);
+    while (running) {
+        if (poll(fds.data(), fds.size(), -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            std::cerr << "Error polling sockets: " << strerror(errno) << std::endl;
+            exit(-1);
+        }
 
+        if (fds[0].revents & POLLIN) {
             if (settings.mode == TCP) {
-                if (const ssize_t sent = send(sock, ptr, message->protocol.size, 0); sent < 0) {
-                    std::cerr << "Error writing to socket" << std::endl;
-                    exit(-1);
+                const int sock = accept(fds[0].fd, nullptr, nullptr);
+                if (sock < 0) {
+                    std::cerr << "Error accepting connection: " << strerror(errno) << std::endl;
+                } else {
+                    constexpr int busy_poll_interval = 50;
+                    if (setsockopt(sock, SOL_SOCKET, SO_BUSY_POLL, &busy_poll_interval,
+                                   sizeof(busy_poll_interval)) < 0) {
+                        std::cerr << "Error setting SO_BUSY_POLL" << std::endl;
+                        exit(-1);
+                    }
+                    // Replies can overlap when a client has several probes in flight, Nagle would hold them back.
+                    constexpr int noDelay = 1;
+                    if (setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay)) < 0) {
+                        std::cerr << "Error setting TCP_NODELAY" << std::endl;
+                        exit(-1);
+                    }
+                    fds.push_back({sock, POLLIN, 0});
                 }
+            } else if (const std::optional<Message> message = recvMessage(fds[0].fd, settings.mode);
+                message.has_value()) {
+                sendReply(settings, fds[0].fd, *message);
             } else {
-                sendto(sock, ptr, message->protocol.size, 0, reinterpret_cast<const sockaddr *>(&message->sender), sizeof(message->sender));
+                fds[0].fd = setupSocket(settings);
+            }
+        }
+
+        // Walk backwards so closed clients can be erased in place.
+        for (std::size_t i = fds.size() - 1; i > 0; i--) {
+            if (fds[i].revents == 0) {
+                continue;
+            }
+
+            // A reset client must not take the other connections down with it.
+            if (fds[i].revents & (POLLERR | POLLNVAL) || (fds[i].revents & POLLHUP && !(fds[i].revents & POLLIN))) {
+                close(fds[i].fd);
+                fds.erase(fds.begin() + static_cast<long>(i));
+                continue;
+            }
+
+            const std::optional<Message> message = recvMessage(fds[i].fd, settings.mode);
+            if (!message.has_value()) {
+                fds.erase(fds.begin() + static_cast<long>(i));
+                continue;
+            }
+
+            if (!sendReply(settings, fds[i].fd, *message)) {
+                close(fds[i].fd);
+                fds.erase(fds.begin() + static_cast<long>(i));
             }
         }
     }
-}
\ No newline at end of file
+}
@@ -16,7 +16,11 @@ OPTIONS:
 
 
 CLIENT USAGE:
-  bounceping <destination> [options]
+  bounceping <destination>[,<destination>...] [options]
+
+  Passing multiple comma separated destinations starts mesh mode. Every
+  destination gets its own connection and probes are interleaved across
+  them, a total of tests * batches * count rounds is sent.
 
 OPTIONS:
   -h             Show this help page
@@ -28,8 +32,11 @@ OPTIONS:
   -b <batches>   Batches per test
   -i <seconds>   Interval between tests
   -o <file>      Output file for detailed results
-  -T <ms>        Delay threshold; filter out excessively long responses
+  -T <us>        Delay threshold; responses above it are counted as outliers
+  -O <factor>    Count responses more than factor * MAD above the running median as outliers
+  -B <ms>        Back off the connection for this long after an outlier
   -m <mode>      Set the server mode: TCP | UDP | TCP_STREAM (Default: TCP_STREAM)
+  -R <us>        Mesh mode: time for one round over all destinations (default 10000)
 
 
 EXAMPLES:
@@ -38,5 +45,8 @@ EXAMPLES:
 
   Run a latency test to 192.168.1.10 with 5 batches of 10 messages:
     bounceping 192.168.1.10 -b 5 -c 10
+
+  Build a latency matrix to three hosts, writing every round to mesh.txt:
+    bounceping 10.0.0.1,10.0.0.2,10.0.0.3 -b 100 -o mesh.txt
 )" << std::endl;
 }
@@ -1,9 +1,11 @@
 #include "utils.hpp"
 
 #include <algorithm>
+#include <cmath>
 #include <cstring>
 #include <iostream>
 #include <ostream>
+#include <sstream>
 #include <stdexcept>
 #include <arpa/inet.h>
 #include <netinet/in.h>
@@ -30,6 +32,18 @@ int safeStoi(const std::string& input) {
     }
 }
 
+double safeStod(const std::string& input) {
+    try {
+        return std::stod(input);
+    }
+    catch (const std::invalid_argument & e) {
+        return -1;
+    }
+    catch (const std::out_of_range & e) {
+        return -1;
+    }
+}
+
 bool validateIpAddress(const std::string& ipAddress) {
     sockaddr_in sockaddr{};
     return inet_pton(AF_INET, ipAddress.c_str(), &sockaddr.sin_addr) != 0;
@@ -67,17 +81,53 @@ bool lockMemory() {
     return true;
 }
 
-std::optional<Message> recvMessage(const int& sock) {
+// Reads exactly length bytes from a stream socket. Returns the amount read, 0 when the socket closed or -1 on error.
+static ssize_t recvAll(const int sock, unsigned char* buffer, const std::size_t length) {
+    std::size_t received = 0;
+    while (received < length) {
+        const ssize_t bytes = recv(sock, buffer + received, length - received, 0);
+        if (bytes < 0 && errno == EINTR) {
+            continue;
+        }
+        if (bytes <= 0) {
+            return bytes;
+        }
+        received += static_cast<std::size_t>(bytes);
+    }
+    return static_cast<ssize_t>(received);
+}
+
+std::optional<Message> recvMessage(const int& sock, const Mode mode) {
     unsigned char buffer[1500];
 
     sockaddr_in sender{};
     socklen_t senderLength = sizeof(sender);
 
-    const ssize_t bytes = recvfrom(sock, &buffer, sizeof(buffer), 0, reinterpret_cast<sockaddr*>(&sender), &senderLength);
+    ssize_t bytes;
+    if (mode == TCP) {
+        // TCP is a stream, so read the header first and then the rest of the message by its size. Messages that were
+        // coalesced or split up on the way are still read one at a time.
+        bytes = recvAll(sock, buffer, sizeof(Protocol));
+        if (bytes > 0) {
+            std::uint32_t size;
+            std::memcpy(&size, buffer, 4);
+            if (size < sizeof(Protocol) || size > sizeof(buffer)) {
+                std::cerr << "Invalid message size: " << size << std::endl;
+                close(sock);
+                return std::nullopt;
+            }
+            if (size > sizeof(Protocol)) {
+                bytes = recvAll(sock, buffer + sizeof(Protocol), size - sizeof(Protocol));
+            }
+        }
+    } else {
+        bytes = recvfrom(sock, &buffer, sizeof(buffer), 0, reinterpret_cast<sockaddr*>(&sender), &senderLength);
+    }
+    // Errors are not fatal, the socket is closed and the caller decides whether the run can go on without it.
     if (bytes < 0) {
         std::cerr << "Error reading from socket: " << strerror(errno) << std::endl;
         close(sock);
-        exit(-1);
+        return std::nullopt;
     }
     if (bytes == 0) {
         if (close(sock) < 0) {
@@ -105,4 +155,26 @@ std::optional<Message> recvMessage(const int& sock) {
     message.sender = sender;
 
     return message;
+}
+
+std::vector<std::string> splitString(const std::string& input, const char delimiter) {
+    std::vector<std::string> parts;
+    std::stringstream stream(input);
+    std::string part;
+
+    while (std::getline(stream, part, delimiter)) {
+        if (!part.empty()) {
+            parts.push_back(part);
+        }
+    }
+    return parts;
+}
+
+// Nearest-rank percentile, expects the samples to already be sorted.
+std::uint64_t percentile(const std::vector<std::uint64_t>& sorted, const double fraction) {
+    if (sorted.empty()) {
+        return 0;
+    }
+    const auto rank = static_cast<std::size_t>(std::ceil(fraction * static_cast<double>(sorted.size())));
+    return sorted[std::clamp<std::size_t>(rank, 1, sorted.size()) - 1];
 }
\ No newline at end of file